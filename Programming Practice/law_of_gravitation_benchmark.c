@@ -0,0 +1,299 @@
+// benchmarks the hot paths of law_of_gravitationV2.c and writes the results as JSON
+// build: gcc -O2 -fno-math-errno -fopenmp law_of_gravitation_benchmark.c -o law_of_gravitation_benchmark -lm
+// the number of objects is fixed at compile time, sweep it with e.g. -DNO_OBJECTS=64
+// usage: law_of_gravitation_benchmark [repeats] [warmup] > results.json
+#define GRAVITY_NO_MAIN
+
+#ifndef NO_OBJECTS
+#define NO_OBJECTS 16
+#endif
+
+// largest resolution in the sweep
+#define NO_PIXELSX 128
+#define NO_PIXELSY 160
+
+#include "law_of_gravitationV2.c"
+
+#define MAX_REPEATS 1000
+
+// settings
+int repeats = 10; // timed batches per benchmark, the median is the headline figure
+int warmup = 3;   // untimed batches run first
+
+// state shared with the benchmark bodies
+Object bench_objects[NO_OBJECTS];
+Object *bench_log = NULL;
+Object *bench_scratch_log = NULL; // update_log writes here so the simulated log stays intact for the benchmarks reading it
+long long bench_log_entries = 0;
+Vec3 *bench_points = NULL;
+Mat3 bench_view;
+char bench_frame[FRAME_BUFFER_SIZE];
+volatile double bench_sink; // keeps results alive so loops are not optimised away
+
+bool first_result = true;
+
+// benchmark prototypes
+void setup_objects(Object objects[]);
+void prepare_log(long long time_seconds);
+int compare_doubles(const void *, const void *);
+void run_benchmark(const char *name, void (*body)(void), long long iterations, const char *parameters);
+bool check_massless_particles();
+
+// benchmark bodies
+void bench_forces();
+void bench_update();
+void bench_update_log();
+void bench_log_scan();
+void bench_view_transform();
+void bench_render();
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+        repeats = atoi(argv[1]);
+    if (argc > 2)
+        warmup = atoi(argv[2]);
+
+    if (repeats < 1 || repeats > MAX_REPEATS || warmup < 0)
+    {
+        fprintf(stderr, "usage: %s [repeats 1-%d] [warmup]\n", argv[0], MAX_REPEATS);
+        return EXIT_FAILURE;
+    }
+
+    // timings of a broken kernel mean nothing
+    if (!check_massless_particles())
+        return EXIT_FAILURE;
+
+#ifdef _OPENMP
+    bool openmp = true;
+#else
+    bool openmp = false;
+#endif
+
+    printf("{\n  \"no_objects\": %d,\n  \"openmp\": %s,\n  \"repeats\": %d,\n  \"warmup\": %d,\n  \"results\": [",
+           NO_OBJECTS, openmp ? "true" : "false", repeats, warmup);
+
+    char parameters[128];
+
+    // physics kernels
+    setup_objects(bench_objects);
+    partition_objects(bench_objects);
+    run_benchmark("apply_gravitational_forces_N", bench_forces, 2000000 / (NO_OBJECTS * NO_OBJECTS) + 1, "");
+    run_benchmark("update_N", bench_update, 1000000 / NO_OBJECTS + 1, "");
+
+    // log access and rendering over a range of log lengths
+    long long log_lengths[] = {DAY, WEEK, WEEK * 4};
+    int resolutions[][2] = {{16, 20}, {32, 40}, {64, 80}, {NO_PIXELSX, NO_PIXELSY}};
+
+    for (int i = 0; i < (int)(sizeof(log_lengths) / sizeof(log_lengths[0])); i++)
+    {
+        prepare_log(log_lengths[i]);
+        snprintf(parameters, sizeof(parameters), "\"log_entries\": %lld", bench_log_entries);
+
+        run_benchmark("update_log", bench_update_log, 1, parameters);
+        run_benchmark("get_log_data_scan", bench_log_scan, 1, parameters);
+        run_benchmark("mat3_transform_array", bench_view_transform, 1, parameters);
+
+        for (int j = 0; j < (int)(sizeof(resolutions) / sizeof(resolutions[0])); j++)
+        {
+            camera.no_pixelsX = resolutions[j][0];
+            camera.no_pixelsY = resolutions[j][1];
+
+            snprintf(parameters, sizeof(parameters), "\"log_entries\": %lld, \"resolution\": \"%dx%d\"",
+                     bench_log_entries, resolutions[j][0], resolutions[j][1]);
+            run_benchmark("build_frame", bench_render, 1, parameters);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+
+    free(bench_log);
+    free(bench_scratch_log);
+    free(bench_points);
+
+    return 0;
+}
+
+/*
+    harness
+*/
+// runs warmup batches then times repeats batches of iterations calls, writes one JSON result
+void run_benchmark(const char *name, void (*body)(void), long long iterations, const char *parameters)
+{
+    double samples[MAX_REPEATS];
+
+    for (int i = 0; i < warmup; i++)
+    {
+        for (long long j = 0; j < iterations; j++)
+            body();
+    }
+
+    for (int i = 0; i < repeats; i++)
+    {
+        double start = platform_time();
+        for (long long j = 0; j < iterations; j++)
+            body();
+
+        samples[i] = (platform_time() - start) * 1e9 / iterations;
+    }
+
+    qsort(samples, repeats, sizeof(double), compare_doubles);
+
+    double mean = 0;
+    for (int i = 0; i < repeats; i++)
+        mean += samples[i] / repeats;
+
+    double median = (repeats % 2) ? samples[repeats / 2] : (samples[repeats / 2 - 1] + samples[repeats / 2]) / 2;
+
+    printf("%s\n    {\"name\": \"%s\", %s%s\"iterations\": %lld, \"min_ns\": %.1f, \"median_ns\": %.1f, \"mean_ns\": %.1f, \"max_ns\": %.1f}",
+           first_result ? "" : ",", name, parameters, parameters[0] ? ", " : "", iterations,
+           samples[0], median, mean, samples[repeats - 1]);
+    fflush(stdout);
+
+    first_result = false;
+}
+
+int compare_doubles(const void *a, const void *b)
+{
+    double difference = *(const double *)a - *(const double *)b;
+    return (difference > 0) - (difference < 0);
+}
+
+/*
+    checks
+*/
+// a massless test particle must still have a finite position after a day of steps
+bool check_massless_particles()
+{
+    Object objects[NO_OBJECTS];
+
+    setup_objects(objects);
+    objects[NO_OBJECTS - 1].mass = 0;
+    objects[NO_OBJECTS - 1].test_particle = true;
+    partition_objects(objects);
+    run_delta_time = delta_time;
+
+    for (long long step = 0; step < DAY / run_delta_time; step++)
+    {
+        apply_gravitational_forces_N(objects);
+        update_N(objects);
+    }
+
+    Vec3 position = objects[NO_OBJECTS - 1].motion.position;
+    if (isfinite(position.x) && isfinite(position.y) && isfinite(position.z))
+        return true;
+
+    fprintf(stderr, "check failed: a massless test particle has a non-finite position after a day\n");
+    return false;
+}
+
+/*
+    setup
+*/
+// a central body with the rest on circular orbits at increasing radii and inclinations
+void setup_objects(Object objects[])
+{
+    objects[0] = (Object){.mass = 5.972e24, .symbol = 'E'};
+
+    for (int i = 1; i < NO_OBJECTS; i++)
+    {
+        double radius = 2e7 + i * 1e7;
+        double angle = i * 2.4;
+        double inclination = i * 0.1;
+        double speed = sqrt(GRAVITATIONAL_CONSTANT * objects[0].mass / radius);
+
+        objects[i] = (Object){.mass = 1e20, .symbol = 'a' + (i - 1) % 26};
+        objects[i].motion.position = (Vec3){radius * cos(angle), radius * sin(angle) * cos(inclination), radius * sin(angle) * sin(inclination)};
+        objects[i].motion.velocity = (Vec3){-speed * sin(angle), speed * cos(angle) * cos(inclination), speed * cos(angle) * sin(inclination)};
+    }
+}
+
+// simulates a log of the given length for the log and render benchmarks
+void prepare_log(long long time_seconds)
+{
+    Object initial_objects[NO_OBJECTS];
+    Object objects[NO_OBJECTS];
+
+    setup_objects(initial_objects);
+
+    time_scale = time_seconds;
+    bench_log = allocate_log(bench_log, time_seconds);
+    simulate(bench_log, initial_objects, objects, time_seconds);
+
+    bench_log_entries = run_log_entries;
+
+    free(bench_scratch_log);
+    bench_scratch_log = malloc(bench_log_entries * NO_OBJECTS * sizeof(Object));
+    if (!bench_scratch_log)
+    {
+        perror("malloc failed");
+        exit(EXIT_FAILURE);
+    }
+
+    free(bench_points);
+    bench_points = malloc(bench_log_entries * NO_OBJECTS * sizeof(Vec3));
+    if (!bench_points)
+    {
+        perror("malloc failed");
+        exit(EXIT_FAILURE);
+    }
+
+    for (long long i = 0; i < bench_log_entries; i++)
+    {
+        for (int j = 0; j < NO_OBJECTS; j++)
+            bench_points[i * NO_OBJECTS + j] = bench_log[i * NO_OBJECTS + j].motion.position;
+    }
+
+    bench_view = quat_to_mat3(camera_orientation(30, 45));
+}
+
+/*
+    benchmark bodies
+*/
+void bench_forces()
+{
+    apply_gravitational_forces_N(bench_objects);
+    bench_sink = bench_objects[NO_OBJECTS - 1].motion.force.x;
+}
+
+void bench_update()
+{
+    update_N(bench_objects);
+    bench_sink = bench_objects[NO_OBJECTS - 1].motion.position.x;
+}
+
+// writes every entry of a log the length of the simulated one
+void bench_update_log()
+{
+    for (long long i = 0; i < bench_log_entries; i++)
+        update_log(bench_scratch_log, bench_objects, i * run_log_step);
+
+    bench_sink = bench_scratch_log[0].motion.position.x;
+}
+
+// reads every position in the log through get_log_data
+void bench_log_scan()
+{
+    double total = 0;
+
+    for (long long i = 0; i < bench_log_entries; i++)
+    {
+        Object *entry = get_log_data(bench_log, i * run_log_step);
+        for (int j = 0; j < NO_OBJECTS; j++)
+            total += entry[j].motion.position.x + entry[j].motion.position.y + entry[j].motion.position.z;
+    }
+
+    bench_sink = total;
+}
+
+// rotates every logged position into camera axes, the renderer's per point transform
+void bench_view_transform()
+{
+    mat3_transform_array(&bench_view, bench_points, bench_points, bench_log_entries * NO_OBJECTS);
+    bench_sink = bench_points[0].x;
+}
+
+void bench_render()
+{
+    bench_sink = build_frame(bench_log, run_time_reached / 2, bench_frame);
+}
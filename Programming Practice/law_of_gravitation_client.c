@@ -0,0 +1,186 @@
+// connects to the client server of law_of_gravitationV2.c and prints what it streams, linux only
+// build: gcc law_of_gravitation_client.c -o law_of_gravitation_client -lm
+// the number of objects must match the simulation's, e.g. -DNO_OBJECTS=16 if it was built with that
+// usage: law_of_gravitation_client subscribe <interval seconds> [deltas 0/1] [states]
+//        law_of_gravitation_client log <start seconds> <end seconds>
+#define GRAVITY_NO_MAIN
+
+#include "law_of_gravitationV2.c"
+
+#ifdef __linux__
+// client prototypes
+int connect_server();
+bool read_exactly(int fd, void *buffer, size_t length);
+bool send_message(int fd, uint32_t type, const void *payload, size_t length);
+void print_body(int object, SnapshotBody *body);
+
+int main(int argc, char *argv[])
+{
+    bool subscribe = argc >= 3 && strcmp(argv[1], "subscribe") == 0;
+    bool log = argc >= 4 && strcmp(argv[1], "log") == 0;
+
+    if (!subscribe && !log)
+    {
+        fprintf(stderr, "usage: %s subscribe <interval seconds> [deltas 0/1] [states]\n", argv[0]);
+        fprintf(stderr, "       %s log <start seconds> <end seconds>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int fd = connect_server();
+
+    MessageHeader header;
+    HelloMessage hello;
+
+    if (!read_exactly(fd, &header, sizeof(header)) || header.type != MSG_HELLO || header.length != sizeof(hello) || !read_exactly(fd, &hello, sizeof(hello)))
+    {
+        fprintf(stderr, "no hello from the server\n");
+        return EXIT_FAILURE;
+    }
+
+    if (hello.version != SERVER_VERSION || hello.no_objects != NO_OBJECTS)
+    {
+        fprintf(stderr, "the server speaks version %u with %u objects, this client was built for version %d with %d\n",
+                hello.version, hello.no_objects, SERVER_VERSION, NO_OBJECTS);
+        return EXIT_FAILURE;
+    }
+
+    printf("connected: log step %lld seconds, logged to %lld seconds\n", (long long)hello.log_step, (long long)hello.logged_time);
+
+    if (log)
+    {
+        LogRequestMessage request = {atoll(argv[2]), atoll(argv[3])};
+        send_message(fd, MSG_LOG_REQUEST, &request, sizeof(request));
+    }
+    else
+    {
+        SubscribeMessage request = {atoll(argv[2]), argc > 3 ? atoi(argv[3]) : 0, 0};
+        send_message(fd, MSG_SUBSCRIBE, &request, sizeof(request));
+    }
+
+    long long states_wanted = argc > 4 && subscribe ? atoll(argv[4]) : -1; // -1 keeps reading until the server closes
+    long long states = 0;
+    long long entries = 0;
+    size_t bytes = 0;
+
+    static SnapshotBody state[NO_OBJECTS];
+    static char payload[CLIENT_OUTPUT_SIZE];
+
+    while (states_wanted < 0 || states < states_wanted)
+    {
+        if (!read_exactly(fd, &header, sizeof(header)))
+            break;
+
+        if (header.length > sizeof(payload) || !read_exactly(fd, payload, header.length))
+        {
+            fprintf(stderr, "malformed message from the server\n");
+            return EXIT_FAILURE;
+        }
+
+        bytes += sizeof(header) + header.length;
+
+        if (header.type == MSG_STATE || header.type == MSG_DELTA)
+        {
+            int64_t time;
+            memcpy(&time, payload, sizeof(time));
+
+            if (header.type == MSG_STATE)
+                memcpy(state, payload + sizeof(time), sizeof(state));
+            else
+            {
+                // deltas add to the last state, the server tracks the same sums
+                DeltaBody *deltas = (DeltaBody *)(payload + sizeof(time));
+                for (int i = 0; i < NO_OBJECTS; i++)
+                {
+                    state[i].position = vec_add(state[i].position, (Vec3){deltas[i].position[0], deltas[i].position[1], deltas[i].position[2]});
+                    state[i].velocity = vec_add(state[i].velocity, (Vec3){deltas[i].velocity[0], deltas[i].velocity[1], deltas[i].velocity[2]});
+                }
+            }
+
+            printf("%s at %lld seconds (%u bytes)\n", header.type == MSG_STATE ? "state" : "delta", (long long)time, header.length);
+            for (int i = 0; i < NO_OBJECTS; i++)
+                print_body(i, &state[i]);
+
+            states++;
+        }
+        else if (header.type == MSG_LOG_CHUNK)
+        {
+            LogChunkHeader chunk;
+            memcpy(&chunk, payload, sizeof(chunk));
+            SnapshotBody *bodies = (SnapshotBody *)(payload + sizeof(chunk));
+
+            // only the first entry of each chunk is printed
+            printf("chunk of %u entries from %lld seconds\n", chunk.no_entries, (long long)chunk.first_time);
+            for (int i = 0; i < NO_OBJECTS; i++)
+                print_body(i, &bodies[i]);
+
+            entries += chunk.no_entries;
+        }
+        else if (header.type == MSG_LOG_END)
+        {
+            printf("log complete: %lld entries\n", entries);
+            break;
+        }
+    }
+
+    printf("received %zu bytes\n", bytes);
+    close(fd);
+
+    return 0;
+}
+
+int connect_server()
+{
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    strncpy(address.sun_path, SERVER_SOCKET_PATH, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        perror("connect failed");
+        exit(EXIT_FAILURE);
+    }
+
+    return fd;
+}
+
+// blocks until length bytes have been read, returns false if the server closes first
+bool read_exactly(int fd, void *buffer, size_t length)
+{
+    size_t received = 0;
+
+    while (received < length)
+    {
+        ssize_t count = recv(fd, (char *)buffer + received, length - received, 0);
+
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+
+        received += count;
+    }
+
+    return true;
+}
+
+bool send_message(int fd, uint32_t type, const void *payload, size_t length)
+{
+    MessageHeader header = {type, (uint32_t)length};
+
+    return send(fd, &header, sizeof(header), MSG_NOSIGNAL) == sizeof(header) &&
+           send(fd, payload, length, MSG_NOSIGNAL) == (ssize_t)length;
+}
+
+void print_body(int object, SnapshotBody *body)
+{
+    printf("  %c%-4d position %14.6e %14.6e %14.6e  velocity %14.6e %14.6e %14.6e\n", body->symbol, object,
+           body->position.x, body->position.y, body->position.z, body->velocity.x, body->velocity.y, body->velocity.z);
+}
+
+#else
+int main()
+{
+    fprintf(stderr, "the client server is only supported on linux\n");
+    return EXIT_FAILURE;
+}
+#endif
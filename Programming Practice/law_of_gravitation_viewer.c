@@ -0,0 +1,75 @@
+// watches a running simulation through the shared memory snapshot published by law_of_gravitationV2.c
+// build: gcc law_of_gravitation_viewer.c -o law_of_gravitation_viewer -lm (older glibc also needs -lrt)
+// the number of objects must match the simulation's, e.g. -DNO_OBJECTS=16 if it was built with that
+// turn publishing on in the simulation settings, then run: law_of_gravitation_viewer [refreshes per second]
+// any key quits, the simulation removes the segment when it exits
+#define GRAVITY_NO_MAIN
+
+#include "law_of_gravitationV2.c"
+
+int main(int argc, char *argv[])
+{
+    int refresh_rate = 4;
+
+    if (argc > 1)
+        refresh_rate = atoi(argv[1]);
+
+    if (refresh_rate < 1 || refresh_rate > 120)
+    {
+        fprintf(stderr, "usage: %s [refreshes per second 1-120]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    platform_enable_raw_input();
+
+    Snapshot *snapshot = NULL;
+    Snapshot copy;
+    unsigned last_sequence = 1; // odd, so the first consistent copy is always shown
+
+    FramePacer pacer;
+    pacer_start(&pacer, refresh_rate);
+
+    while (platform_read_key() < 0)
+    {
+        // the simulation only creates the segment once it first publishes
+        if (snapshot == NULL)
+        {
+            snapshot = open_snapshot(false);
+            if (snapshot == NULL)
+            {
+                printf("\rWaiting for a simulation to publish to %s...", SNAPSHOT_NAME);
+                fflush(stdout);
+                pacer_wait(&pacer);
+                continue;
+            }
+        }
+
+        unsigned sequence;
+
+        // a writer stuck part way through a write is waited out a poll at a time, so keys are still read
+        if (read_snapshot(snapshot, &copy, &sequence) && sequence != last_sequence)
+        {
+            printf("\033[2J\033[H\n%s", display_time(copy.time));
+            printf("\nDELTA TIME: %lld seconds   SNAPSHOTS: %u\n\n", copy.delta_time, sequence / 2);
+            printf("%-8s %-14s %-14s %-14s %-14s %-14s %-14s %-14s\n", "OBJECT", "MASS", "X", "Y", "Z", "VX", "VY", "VZ");
+
+            for (int i = 0; i < NO_OBJECTS; i++)
+            {
+                SnapshotBody *body = &copy.bodies[i];
+                printf("%c%-7d %-14.6e %-14.6e %-14.6e %-14.6e %-14.6e %-14.6e %-14.6e\n", body->symbol, i, body->mass,
+                       body->position.x, body->position.y, body->position.z,
+                       body->velocity.x, body->velocity.y, body->velocity.z);
+            }
+
+            fflush(stdout);
+            last_sequence = sequence;
+        }
+
+        pacer_wait(&pacer);
+    }
+
+    platform_disable_raw_input();
+    printf("\n");
+
+    return 0;
+}